@@ -3,11 +3,22 @@
 //   - Loads assets (bitmaps, fonts)
 //   - Manages dynamic arrays of falling rocks and power‑ups
 //   - Handles game state, input, rendering, collisions, and scoring
+//   - Renders through a renderer backend: SplashKit window or in-memory software framebuffer
+//   - Logs debug records through a lock-free ring buffer written out on a background thread
+//   - Accounts heap use per category (rocks, arrays, assets, game objects), plus an estimate of string churn
+//   - Keeps an append-only history of sessions with per-difficulty leaderboards
 
 #include "splashkit.h"
 #include <cstdlib>
+#include <cmath>
 #include <stdio.h>
+#include <string.h>
+#include <stddef.h>
 #include <new> 
+#include <type_traits>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 using std::to_string;
 
@@ -18,25 +29,210 @@ const int BUFFER = 250;
 const int FONT_SIZE = 30;       
 const font FONT1 = load_font("font1", "Roboto-italic.ttf");
 
-bitmap IMAGES[7];
+const int SPRITE_COUNT = 8;
+bitmap IMAGES[SPRITE_COUNT];
+int SPRITE_WIDTH[SPRITE_COUNT];// Pixel sizes of the sprite files, known even when no bitmaps are loaded
+int SPRITE_HEIGHT[SPRITE_COUNT];
 
 const long WIND_CHANGE_TIME = 4000; // Every 4 seconds the wind changes direction
 const int MAX_WIND = 5; // Maximum wind speed
 
-//Probabilities of power up drops, the rest will be rocks
-const double POTION_RATE = 0.03; 
-const double COIN_RATE = 0.2;
-const double TIME_SLOW_RATE = 0.1;
-
 const long MAX_TIME_SLOW = 8000; // Maximum time slow in milliseconds
 
+// Scripted (headless) runs: no window or input, a fixed number of frames on a frame-driven clock
+bool SCRIPTED = false;
+unsigned int SCRIPTED_TICKS = 0;
+const unsigned int SCRIPTED_FRAME_MS = 16;
+
+const int DIFFICULTY_COUNT = 4; // Menu choices: exit, easy, medium, hard
+const int LEADERBOARD_SIZE = 10; // Top scores kept per difficulty
+const string HISTORY_FILE = "sessions.dat";
+
+// Place rocks in closed form from the wind/slow prefix integrals instead of stepping them every frame.
+// Set ROCK_DODGER_LAZY_TRAJECTORIES to turn it on. Off by default: every released rock is on screen,
+// so each still needs a position per frame, and verify_trajectories measures a placement as slower
+// than the two additions of a step.
+bool LAZY_TRAJECTORIES = false;
+
+// Enum alloc_category
+// Buckets for the allocation accounting in ALLOCATIONS
+//   ROCKS   – rock_ objects
+//   ARRAYS  – dynamic_array objects and their element storage
+//   ASSETS  – decoded bitmaps (estimated at 4 bytes per pixel), the software framebuffer and PNG buffers
+//   GAME    – game_state, menu, player_, renderer and logger objects
+// std::string allocations are not routed through here; see alloc_counters::on_string.
+enum alloc_category {
+    ALLOC_ROCKS,
+    ALLOC_ARRAYS,
+    ALLOC_ASSETS,
+    ALLOC_GAME,
+    ALLOC_CATEGORY_COUNT,
+};
+
+const char *ALLOC_NAMES[ALLOC_CATEGORY_COUNT] = {"rocks", "arrays", "assets", "game"};
+
+// Struct alloc_counters
+// Allocation counts, live bytes and high-water marks; only touched from the game thread
+struct alloc_counters
+{
+    long long allocations[ALLOC_CATEGORY_COUNT];
+    long long frees[ALLOC_CATEGORY_COUNT];
+    long long live_bytes[ALLOC_CATEGORY_COUNT];
+    long long total_live;
+    long long high_water;
+    long long frame_allocations;
+    long long last_frame_allocations;// Allocations made during the previous frame
+    long long peak_frame_allocations;
+    long long string_buffers;// Estimate only: heap buffers of text reaching the renderer
+    long long string_bytes;
+
+    void on_alloc(alloc_category category, long long bytes)
+    {
+        allocations[category]++;
+        live_bytes[category] += bytes;
+        total_live += bytes;
+        frame_allocations++;
+        if (total_live > high_water)
+        {
+            high_water = total_live;
+        }
+    }
+
+    void on_free(alloc_category category, long long bytes)
+    {
+        frees[category]++;
+        live_bytes[category] -= bytes;
+        total_live -= bytes;
+    }
+
+    // on_string: estimate of string churn, seen only where text reaches the renderer. A string
+    // longer than the small-string buffer had at least one heap buffer; to_string/operator+
+    // temporaries are not seen, and the estimate stays out of live bytes and the high-water mark.
+    void on_string(const string &text)
+    {
+        if (text.capacity() > 15)
+        {
+            string_buffers++;
+            string_bytes += text.capacity() + 1;
+        }
+    }
+
+    // end_frame: close the per-frame allocation count, called once per presented frame
+    void end_frame()
+    {
+        last_frame_allocations = frame_allocations;
+        if (frame_allocations > peak_frame_allocations)
+        {
+            peak_frame_allocations = frame_allocations;
+        }
+        frame_allocations = 0;
+    }
+
+    // print: report every category plus totals, used at process exit
+    void print()
+    {
+        printf("Allocations:\n");
+        for (int i = 0; i < ALLOC_CATEGORY_COUNT; i++)
+        {
+            printf("  %-8s %10lld allocs %10lld frees %12lld live bytes\n", ALLOC_NAMES[i], allocations[i], frees[i], live_bytes[i]);
+        }
+        printf("  strings (estimate, drawn text only): %lld heap buffers, %lld bytes\n", string_buffers, string_bytes);
+        printf("  live bytes: %lld, high-water mark: %lld\n", total_live, high_water);
+        printf("  allocations per frame: %lld last, %lld peak\n", last_frame_allocations, peak_frame_allocations);
+    }
+};
+
+// Global allocation accounting, zero-initialized before anything can allocate
+alloc_counters ALLOCATIONS;
+
+// tracked_malloc / tracked_realloc / tracked_free:
+// malloc family with a 16-byte header recording size and category, so frees are attributed correctly
+const size_t ALLOC_HEADER = 16;
+
+void *tracked_malloc(size_t size, alloc_category category)
+{
+    char *base = (char *)malloc(size + ALLOC_HEADER);
+    if (base == nullptr)
+    {
+        return nullptr;
+    }
+    *(size_t *)base = size;
+    *(alloc_category *)(base + sizeof(size_t)) = category;
+    ALLOCATIONS.on_alloc(category, size);
+    return base + ALLOC_HEADER;
+}
+
+void *tracked_realloc(void *ptr, size_t size, alloc_category category)
+{
+    if (ptr == nullptr)
+    {
+        return tracked_malloc(size, category);
+    }
+    char *base = (char *)ptr - ALLOC_HEADER;
+    size_t old_size = *(size_t *)base;
+    alloc_category old_category = *(alloc_category *)(base + sizeof(size_t));
+
+    base = (char *)realloc(base, size + ALLOC_HEADER);
+    if (base == nullptr)
+    {
+        return nullptr;
+    }
+    *(size_t *)base = size;
+    *(alloc_category *)(base + sizeof(size_t)) = category;
+    ALLOCATIONS.on_free(old_category, old_size);
+    ALLOCATIONS.on_alloc(category, size);
+    return base + ALLOC_HEADER;
+}
+
+void tracked_free(void *ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    char *base = (char *)ptr - ALLOC_HEADER;
+    ALLOCATIONS.on_free(*(alloc_category *)(base + sizeof(size_t)), *(size_t *)base);
+    free(base);
+}
+
+// Template tracked<C>
+// Base that routes new/delete of the derived struct through the tracked allocator under category C
+template <alloc_category C>
+struct tracked
+{
+    static void *operator new(size_t size)
+    {
+        void *ptr = tracked_malloc(size, C);
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    static void operator delete(void *ptr)
+    {
+        tracked_free(ptr);
+    }
+
+    // Placement forms, otherwise hidden by the operators above
+    static void *operator new(size_t, void *ptr)
+    {
+        return ptr;
+    }
+
+    static void operator delete(void *, void *)
+    {
+    }
+};
+
 // Template dynamic_array<T>
 // A simple resizable array with manual memory management.
 // - capacity: total allocated slots
 // - size: current number of elements
 // - data: raw pointer to T elements
 template <typename T>
-struct dynamic_array
+struct dynamic_array : tracked<ALLOC_ARRAYS>
 {
     int capacity;
     int size;
@@ -46,7 +242,7 @@ struct dynamic_array
     dynamic_array(int capacity)
     {
         size = 0;
-        data = new T[capacity];
+        data = (T *)tracked_malloc(capacity * sizeof(T), ALLOC_ARRAYS);
 
         for (int i = 0; i < capacity; i++)
         {
@@ -74,7 +270,7 @@ struct dynamic_array
         capacity = 0;
 
 // Free the data in the array
-        delete[] data;
+        tracked_free(data);
 // Free the array itself
         
     }
@@ -87,7 +283,7 @@ struct dynamic_array
             data[i].~T();
         }
 
-        T *new_data = (T *)realloc(data, new_capacity * sizeof(T));
+        T *new_data = (T *)tracked_realloc(data, new_capacity * sizeof(T), ALLOC_ARRAYS);
 
         if (new_data == nullptr)
         {
@@ -111,6 +307,20 @@ struct dynamic_array
         return true; // Resizing succeeded
     }
 
+    // remove_unordered: drop element at index by moving the last element into its slot
+    bool remove_unordered(unsigned int index)
+    {
+        if (index >= (unsigned int) size)
+        {
+            return false;
+        }
+
+        data[index] = data[size - 1];
+        size--;
+
+        return true;
+    }
+
     // add: append new element, grow if needed
     bool add(T value)
     {
@@ -149,156 +359,1316 @@ struct dynamic_array
         return data[index];
     }
 
-    // get: safe retrieval returning default on OOB
-    T get(unsigned int index)
+    // get: safe retrieval returning default on OOB
+    T get(unsigned int index)
+    {
+        if (index < 0 || index >= size)
+        {
+            return 0; // Return the default value
+        }
+        return data[index]; // Return the value at the index
+    }
+
+    // set: safe assignment with bounds check
+    bool set(unsigned int index, T value)
+    {
+        if (index >= size)
+        {
+            return false;
+        }
+
+        data[index] = value;
+        return true;
+    }
+
+    // print: debug helper to log contents, size, and capacity
+    void print()
+    {
+        printf("Dynamic array capacity: %d\n", capacity);
+        printf("Dynamic array size: %d\n", size);
+        printf("Dynamic array: [");
+        for (int i = 0; i < size; i++)
+        {
+            printf("%d", data[i]);
+            if (i < size - 1)
+            {
+                printf(", ");
+            }
+        }
+        printf("]\n");
+    }
+};
+
+// now_ms: game clock in milliseconds, SplashKit ticks normally or the frame clock when scripted
+unsigned int now_ms()
+{
+    return SCRIPTED ? SCRIPTED_TICKS : current_ticks();
+}
+
+// Struct game_timer
+// Pausable stopwatch on now_ms() with the same semantics as SplashKit timers,
+// so game timing also runs (deterministically) in scripted mode
+struct game_timer
+{
+    bool started;
+    bool paused;
+    unsigned int start_ticks;
+    unsigned int paused_ticks;
+
+    game_timer()
+    {
+        started = false;
+        paused = false;
+        start_ticks = 0;
+        paused_ticks = 0;
+    }
+
+    void start()
+    {
+        started = true;
+        paused = false;
+        start_ticks = now_ms();
+    }
+
+    void reset()
+    {
+        start_ticks = now_ms();
+        paused_ticks = 0;
+    }
+
+    void pause()
+    {
+        if (started && !paused)
+        {
+            paused = true;
+            paused_ticks = now_ms() - start_ticks;
+        }
+    }
+
+    void resume()
+    {
+        if (started && paused)
+        {
+            paused = false;
+            start_ticks = now_ms() - paused_ticks;
+        }
+    }
+
+    unsigned int ticks()
+    {
+        if (!started)
+        {
+            return 0;
+        }
+        return paused ? paused_ticks : now_ms() - start_ticks;
+    }
+};
+
+// png_size: read a PNG's pixel size from its IHDR chunk, without decoding or a display
+bool png_size(const string &path, int &width, int &height)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    unsigned char header[24];
+    bool ok = fread(header, 1, 24, file) == 24 && memcmp(&header[12], "IHDR", 4) == 0;
+    fclose(file);
+    if (ok)
+    {
+        width = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+        height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+    }
+    return ok;
+}
+
+// read_sprite_sizes: fill SPRITE_WIDTH/SPRITE_HEIGHT from the sprite files' headers
+void read_sprite_sizes()
+{
+    for (int i = 0; i < SPRITE_COUNT; i++)
+    {
+        string path = "./" + to_string(i) + ".png";
+        if (!png_size(path, SPRITE_WIDTH[i], SPRITE_HEIGHT[i]))
+        {
+            printf("Could not read %s\n", path.c_str());
+        }
+    }
+}
+
+// unload_images: free the sprite bitmaps loaded by game_state::load_images, so the exit
+// report only shows asset bytes that were actually leaked
+void unload_images()
+{
+    for (int i = 0; i < SPRITE_COUNT; i++)
+    {
+        if (has_bitmap("Rock_"+to_string(i)))
+        {
+            ALLOCATIONS.on_free(ALLOC_ASSETS, (long long) SPRITE_WIDTH[i] * SPRITE_HEIGHT[i] * 4);
+            free_bitmap(IMAGES[i]);
+        }
+    }
+}
+
+// Struct renderer
+// Drawing interface used by every screen, so frames can go to a window or to memory
+//   clear/present bracket a frame; the rest mirror the SplashKit calls the game uses
+struct renderer : tracked<ALLOC_GAME>
+{
+    virtual ~renderer()
+    {
+    }
+
+    virtual void clear(color clr) = 0;
+    virtual void fill_rectangle(color clr, double x, double y, double width, double height) = 0;
+    virtual void draw_rectangle(color clr, double x, double y, double width, double height) = 0;
+    virtual void fill_circle(color clr, double x, double y, double radius) = 0;
+    virtual void draw_circle(color clr, double x, double y, double radius) = 0;
+    virtual void draw_sprite(int sprite, double x, double y, double scale) = 0;
+    virtual void draw_text(const string &text, color clr, font fnt, int size, double x, double y) = 0;
+    virtual void present() = 0;
+};
+
+// Struct splashkit_renderer
+// Forwards every call to the SplashKit window opened in main()
+struct splashkit_renderer : renderer
+{
+    void clear(color clr) override
+    {
+        clear_screen(clr);
+    }
+
+    void fill_rectangle(color clr, double x, double y, double width, double height) override
+    {
+        ::fill_rectangle(clr, x, y, width, height);
+    }
+
+    void draw_rectangle(color clr, double x, double y, double width, double height) override
+    {
+        ::draw_rectangle(clr, x, y, width, height);
+    }
+
+    void fill_circle(color clr, double x, double y, double radius) override
+    {
+        ::fill_circle(clr, x, y, radius);
+    }
+
+    void draw_circle(color clr, double x, double y, double radius) override
+    {
+        ::draw_circle(clr, x, y, radius);
+    }
+
+    void draw_sprite(int sprite, double x, double y, double scale) override
+    {
+        ::draw_bitmap(IMAGES[sprite], x, y, option_scale_bmp(scale, scale));
+    }
+
+    void draw_text(const string &text, color clr, font fnt, int size, double x, double y) override
+    {
+        ALLOCATIONS.on_string(text);
+        ::draw_text(text, clr, fnt, size, x, y);
+    }
+
+    void present() override
+    {
+        refresh_screen();
+    }
+};
+
+// Struct software_renderer
+// CPU rasterizer drawing into an in-memory RGBA framebuffer (no display needed)
+//  - Shapes are rasterized exactly; bitmaps and text have no pixel data here, so they
+//    are drawn as solid boxes of their on-screen size (stable for golden images)
+//  - present() counts frames and, if frame_prefix is set, dumps each frame as a PPM or PNG
+struct software_renderer : renderer
+{
+    int width;
+    int height;
+    unsigned char *pixels;
+    unsigned long frame_count;
+    string frame_prefix;
+    bool frame_png;// Dump frames as PNG instead of PPM
+
+    software_renderer(int _width, int _height, const string &_frame_prefix = "", bool _frame_png = false)
+    {
+        width = _width;
+        height = _height;
+        frame_png = _frame_png;
+        pixels = (unsigned char *)tracked_malloc(width * height * 4, ALLOC_ASSETS);
+        frame_count = 0;
+        frame_prefix = _frame_prefix;
+        memset(pixels, 0, width * height * 4);
+    }
+
+    ~software_renderer()
+    {
+        tracked_free(pixels);
+    }
+
+    // blend: alpha-blend clr over the pixel at (x,y), ignoring anything off the framebuffer
+    void blend(int x, int y, color clr)
+    {
+        if (x < 0 || y < 0 || x >= width || y >= height)
+        {
+            return;
+        }
+        unsigned char *px = &pixels[(y * width + x) * 4];
+        double a = clr.a;
+        px[0] = (unsigned char)(clr.r * 255 * a + px[0] * (1 - a));
+        px[1] = (unsigned char)(clr.g * 255 * a + px[1] * (1 - a));
+        px[2] = (unsigned char)(clr.b * 255 * a + px[2] * (1 - a));
+        px[3] = 255;
+    }
+
+    // span: fill pixels [x0,x1) on row y
+    void span(int x0, int x1, int y, color clr)
+    {
+        if (y < 0 || y >= height)
+        {
+            return;
+        }
+        if (x0 < 0)
+        {
+            x0 = 0;
+        }
+        if (x1 > width)
+        {
+            x1 = width;
+        }
+        for (int x = x0; x < x1; x++)
+        {
+            blend(x, y, clr);
+        }
+    }
+
+    void clear(color clr) override
+    {
+        for (int i = 0; i < width * height; i++)
+        {
+            pixels[i * 4 + 0] = (unsigned char)(clr.r * 255);
+            pixels[i * 4 + 1] = (unsigned char)(clr.g * 255);
+            pixels[i * 4 + 2] = (unsigned char)(clr.b * 255);
+            pixels[i * 4 + 3] = 255;
+        }
+    }
+
+    void fill_rectangle(color clr, double x, double y, double w, double h) override
+    {
+        int x0 = (int)x;
+        int x1 = (int)(x + w);
+        for (int row = (int)y; row < (int)(y + h); row++)
+        {
+            span(x0, x1, row, clr);
+        }
+    }
+
+    void draw_rectangle(color clr, double x, double y, double w, double h) override
+    {
+        int x0 = (int)x;
+        int y0 = (int)y;
+        int x1 = (int)(x + w) - 1;
+        int y1 = (int)(y + h) - 1;
+        span(x0, x1 + 1, y0, clr);
+        span(x0, x1 + 1, y1, clr);
+        for (int row = y0 + 1; row < y1; row++)
+        {
+            blend(x0, row, clr);
+            blend(x1, row, clr);
+        }
+    }
+
+    void fill_circle(color clr, double x, double y, double radius) override
+    {
+        for (int row = (int)(y - radius); row <= (int)(y + radius); row++)
+        {
+            double dy = row + 0.5 - y;
+            if (dy * dy > radius * radius)
+            {
+                continue;
+            }
+            double dx = sqrt(radius * radius - dy * dy);
+            span((int)(x - dx + 0.5), (int)(x + dx + 0.5), row, clr);
+        }
+    }
+
+    void draw_circle(color clr, double x, double y, double radius) override
+    {
+        for (int row = (int)(y - radius) - 1; row <= (int)(y + radius) + 1; row++)
+        {
+            for (int col = (int)(x - radius) - 1; col <= (int)(x + radius) + 1; col++)
+            {
+                double dx = col + 0.5 - x;
+                double dy = row + 0.5 - y;
+                double d = sqrt(dx * dx + dy * dy);
+                if (d >= radius - 0.5 && d < radius + 0.5)
+                {
+                    blend(col, row, clr);
+                }
+            }
+        }
+    }
+
+    // draw_sprite: SplashKit scales about the bitmap centre, so the box does the same
+    void draw_sprite(int sprite, double x, double y, double scale) override
+    {
+        double w = SPRITE_WIDTH[sprite];
+        double h = SPRITE_HEIGHT[sprite];
+        color box = {0.5f, 0.5f, 0.5f, 1.0f};
+        fill_rectangle(box, x + w * (1 - scale) / 2, y + h * (1 - scale) / 2, w * scale, h * scale);
+    }
+
+    // draw_text: one box per non-space character, roughly the advance of the glyph
+    void draw_text(const string &text, color clr, font /*fnt*/, int size, double x, double y) override
+    {
+        ALLOCATIONS.on_string(text);
+        double advance = size * 0.5;
+        for (int i = 0; i < (int)text.size(); i++)
+        {
+            if (text[i] != ' ')
+            {
+                fill_rectangle(clr, x + i * advance + 1, y + size * 0.2, advance - 2, size * 0.7);
+            }
+        }
+    }
+
+    void present() override
+    {
+        if (frame_prefix != "")
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "_%06lu.%s", frame_count, frame_png ? "png" : "ppm");
+            if (frame_png)
+            {
+                save_png(frame_prefix + name);
+            }
+            else
+            {
+                save_ppm(frame_prefix + name);
+            }
+        }
+        frame_count++;
+    }
+
+    // save_ppm: write the framebuffer as a binary (P6) PPM, dropping alpha
+    bool save_ppm(const string &path)
+    {
+        FILE *file = fopen(path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            printf("Could not open %s\n", path.c_str());
+            return false;
+        }
+        fprintf(file, "P6\n%d %d\n255\n", width, height);
+        for (int i = 0; i < width * height; i++)
+        {
+            fwrite(&pixels[i * 4], 1, 3, file);
+        }
+        fclose(file);
+        return true;
+    }
+
+    // save_png: write the framebuffer as an RGBA PNG using uncompressed (stored) deflate blocks
+    bool save_png(const string &path)
+    {
+        FILE *file = fopen(path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            printf("Could not open %s\n", path.c_str());
+            return false;
+        }
+
+        const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+        fwrite(signature, 1, 8, file);
+
+        unsigned char header[13];
+        put_u32(header, width);
+        put_u32(header + 4, height);
+        header[8] = 8;  // bit depth
+        header[9] = 6;  // RGBA
+        header[10] = 0; // deflate
+        header[11] = 0; // adaptive filtering
+        header[12] = 0; // no interlace
+        write_chunk(file, "IHDR", header, 13);
+
+        // Raw scanlines, each prefixed with filter type 0
+        unsigned long raw_size = (unsigned long)(width * 4 + 1) * height;
+        unsigned char *raw = (unsigned char *)tracked_malloc(raw_size, ALLOC_ASSETS);
+        for (int y = 0; y < height; y++)
+        {
+            raw[y * (width * 4 + 1)] = 0;
+            memcpy(&raw[y * (width * 4 + 1) + 1], &pixels[y * width * 4], width * 4);
+        }
+
+        // zlib stream: header, stored blocks of at most 65535 bytes, adler32
+        unsigned long blocks = (raw_size + 65534) / 65535;
+        unsigned long zlib_size = 2 + raw_size + blocks * 5 + 4;
+        unsigned char *zlib = (unsigned char *)tracked_malloc(zlib_size, ALLOC_ASSETS);
+        unsigned long pos = 0;
+        zlib[pos++] = 0x78;
+        zlib[pos++] = 0x01;
+        unsigned long a = 1, b = 0;
+        for (unsigned long offset = 0; offset < raw_size; offset += 65535)
+        {
+            unsigned long len = raw_size - offset < 65535 ? raw_size - offset : 65535;
+            zlib[pos++] = (offset + len == raw_size) ? 1 : 0;
+            zlib[pos++] = len & 0xff;
+            zlib[pos++] = (len >> 8) & 0xff;
+            zlib[pos++] = ~len & 0xff;
+            zlib[pos++] = (~len >> 8) & 0xff;
+            memcpy(&zlib[pos], &raw[offset], len);
+            for (unsigned long i = 0; i < len; i++)
+            {
+                a = (a + raw[offset + i]) % 65521;
+                b = (b + a) % 65521;
+            }
+            pos += len;
+        }
+        put_u32(&zlib[pos], (b << 16) | a);
+        pos += 4;
+        write_chunk(file, "IDAT", zlib, pos);
+        write_chunk(file, "IEND", nullptr, 0);
+
+        tracked_free(raw);
+        tracked_free(zlib);
+        fclose(file);
+        return true;
+    }
+
+    static void put_u32(unsigned char *out, unsigned long value)
+    {
+        out[0] = (value >> 24) & 0xff;
+        out[1] = (value >> 16) & 0xff;
+        out[2] = (value >> 8) & 0xff;
+        out[3] = value & 0xff;
+    }
+
+    // write_chunk: length, type, data, then CRC-32 over type and data
+    static void write_chunk(FILE *file, const char *type, const unsigned char *data, unsigned long len)
+    {
+        unsigned char buf[4];
+        put_u32(buf, len);
+        fwrite(buf, 1, 4, file);
+        fwrite(type, 1, 4, file);
+        if (len > 0)
+        {
+            fwrite(data, 1, len, file);
+        }
+
+        unsigned long crc = 0xffffffff;
+        for (unsigned long i = 0; i < 4 + len; i++)
+        {
+            crc ^= (i < 4) ? (unsigned char)type[i] : data[i - 4];
+            for (int k = 0; k < 8; k++)
+            {
+                crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+            }
+        }
+        put_u32(buf, crc ^ 0xffffffff);
+        fwrite(buf, 1, 4, file);
+    }
+};
+
+// Active renderer, chosen in main(): set ROCK_DODGER_RENDERER=software for a headless scripted
+// run on the framebuffer backend (see run_scripted), ROCK_DODGER_FRAME_DUMP=<prefix> to dump every
+// frame as <prefix>_NNNNNN.ppm, and ROCK_DODGER_FRAME_FORMAT=png for PNG frames instead
+renderer *RENDERER = nullptr;
+
+// Enum log_event
+// Record kinds understood by the logger; LOG_FORMATS holds the matching printf format
+enum log_event {
+    LOG_ROCK_COUNTS,
+    LOG_EVENT_COUNT,
+};
+
+// Formats take the record's three values; the writer prefixes each line with the record's time
+const char *LOG_FORMATS[LOG_EVENT_COUNT] = {
+    "Rock Release: %lld, Rock Queue Size: %lld, Rock History Size: %lld\n", // LOG_ROCK_COUNTS
+};
+
+// Struct log_record
+// Fixed-size binary record copied into the ring buffer; formatting is deferred to the writer thread
+struct log_record
+{
+    unsigned long long time_ns;
+    log_event event;
+    long long values[3];
+};
+
+// Struct logger
+// Single-producer/single-consumer lock-free ring buffer of log_records
+//  - log() is called on the game thread: it copies one record in, or drops it when the ring is full
+//  - A background thread drains the ring, formats records and writes them to stdout,
+//    each stamped with its time in milliseconds since the logger started
+//  - Tracks dropped records and the game-thread cost of every log() call in nanoseconds
+struct logger : tracked<ALLOC_GAME>
+{
+    static const unsigned int CAPACITY = 4096;// Must be a power of two
+    static const int MAX_IDLE_MS = 64;// Longest writer sleep; a full ring takes far longer to fill at one record per frame
+
+    log_record ring[CAPACITY];
+    std::atomic<unsigned int> head;// Next slot the game thread writes
+    std::atomic<unsigned int> tail;// Next slot the writer thread reads
+    std::atomic<bool> running;
+    std::thread writer;
+
+    unsigned long long start_ns;
+    unsigned long long calls;
+    unsigned long long dropped;
+    unsigned long long call_ns;
+
+    logger()
+    {
+        start_ns = now_ns();
+        head = 0;
+        tail = 0;
+        calls = 0;
+        dropped = 0;
+        call_ns = 0;
+        running = true;
+        writer = std::thread(&logger::drain, this);
+    }
+
+    // Destructor: stop the writer after it has flushed everything already queued, then report overhead
+    ~logger()
+    {
+        running = false;
+        writer.join();
+        printf("Logger: %llu calls, %llu dropped, %.1f ns per call\n", calls, dropped, average_call_ns());
+    }
+
+    static unsigned long long now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // log: enqueue a record without blocking; returns false if it was dropped
+    bool log(log_event event, long long a = 0, long long b = 0, long long c = 0)
+    {
+        unsigned long long start = now_ns();
+        unsigned int h = head.load(std::memory_order_relaxed);
+        bool queued = h - tail.load(std::memory_order_acquire) < CAPACITY;
+        if (queued)
+        {
+            log_record &record = ring[h & (CAPACITY - 1)];
+            record.time_ns = start;
+            record.event = event;
+            record.values[0] = a;
+            record.values[1] = b;
+            record.values[2] = c;
+            head.store(h + 1, std::memory_order_release);
+        }
+        else
+        {
+            dropped++;
+        }
+        calls++;
+        call_ns += now_ns() - start;
+        return queued;
+    }
+
+    double average_call_ns()
+    {
+        return calls == 0 ? 0 : call_ns / (double) calls;
+    }
+
+    // drain: writer thread loop. Sleeps when the ring is empty, doubling the sleep after each
+    // empty poll up to MAX_IDLE_MS so an idle logger rarely wakes, and back to 1 ms once records arrive.
+    void drain()
+    {
+        int idle_ms = 1;
+        while (true)
+        {
+            bool stopping = !running.load(std::memory_order_acquire);
+            unsigned int t = tail.load(std::memory_order_relaxed);
+            unsigned int h = head.load(std::memory_order_acquire);
+            if (t == h)
+            {
+                if (stopping)
+                {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+                idle_ms = idle_ms*2 > MAX_IDLE_MS ? MAX_IDLE_MS : idle_ms*2;
+                continue;
+            }
+            idle_ms = 1;
+            for (; t != h; t++)
+            {
+                const log_record &record = ring[t & (CAPACITY - 1)];
+                printf("[%12.3f ms] ", (record.time_ns - start_ns) / 1e6);
+                printf(LOG_FORMATS[record.event], record.values[0], record.values[1], record.values[2]);
+            }
+            tail.store(t, std::memory_order_release);
+            fflush(stdout);
+        }
+    }
+};
+
+// Active logger, created in main()
+logger *LOGGER = nullptr;
+
+// Enum _type
+// Defines the categories of falling objects in the game
+//   ROCK      – standard damaging object
+//   POTION    – health restore
+//   TIME_SLOW – slows drop speed temporarily
+//   COIN      – bonus score
+enum  _type {
+    ROCK,
+    POTION,
+    TIME_SLOW,
+    COIN,
+    TYPE_COUNT,
+};
+
+// Struct object_type
+// Compile-time description of one falling object category
+//   drop_rate    – probability of a spawned object being this type (ROCK takes the rest)
+//   sprite       – first index into IMAGES, sprite_count variants are picked at random
+//   damage       – multiplier on fall speed / rock_softness taken from player health
+//   heal         – fraction of max_health restored on pickup
+//   score        – points per unit of difficulty on pickup
+//   slow_time    – milliseconds of time slow added on pickup
+//   track_misses – hits and misses are recorded in rock_history for dodge accuracy
+struct object_type
+{
+    double drop_rate;
+    int sprite;
+    int sprite_count;
+    double damage;
+    double heal;
+    double score;
+    long slow_time;
+    bool track_misses;
+};
+
+// Type table, indexed by _type. Adding a power-up is a new enum entry plus a row here.
+constexpr object_type OBJECT_TYPES[TYPE_COUNT] = {
+//   drop_rate  sprite  count  damage  heal    score  slow_time  track_misses
+    {0.0,       0,      5,     1.0,    0.0,    0.0,   0,         true },   // ROCK
+    {0.03,      5,      1,     0.0,    0.125,  0.0,   0,         false},   // POTION
+    {0.1,       6,      1,     0.0,    0.0,    0.0,   2000,      false},   // TIME_SLOW
+    {0.2,       7,      1,     0.0,    0.0,    1.0,   0,         false},   // COIN
+};
+
+// Struct rock_
+// Represents a single falling object (rock or power‑up)
+// Holds position, velocity, bitmap pointer, type flags, and status (draw/hit/missed)
+struct rock_ : tracked<ALLOC_ROCKS>
+{
+    double x_pos;
+    double y_pos;
+    int sprite;// Index into IMAGES / SPRITE_WIDTH / SPRITE_HEIGHT
+    double velocity[2];
+    bool draw;
+    bool missed;
+    bool hit;
+    _type t;
+
+    unsigned int spawn_tick;// Frame the rock was released on, for closed-form placement
+    double spawn_x;
+    double spawn_y;
+
+    // Constructor:
+    //  - Randomly choose type from the OBJECT_TYPES drop rates, and an image from its sprites
+    //  - Initialize above-screen y position and random downward velocity
+    rock_()
+    {  
+        int rock_i = rnd(5);
+
+        y_pos = -SPRITE_HEIGHT[rock_i]*0.45;
+        velocity[0] = 0;
+        velocity[1] = rnd(20,100)/100.0;
+        draw=true;
+        missed=false;
+        hit=false;
+        float x_ = rnd();
+        t = ROCK;
+        double threshold = 0;
+        for (int i = ROCK + 1; i < TYPE_COUNT; i++)
+        {
+            threshold += OBJECT_TYPES[i].drop_rate;
+            if (x_ < threshold)
+            {
+                t = (_type) i;
+                break;
+            }
+        }
+        sprite = OBJECT_TYPES[t].sprite + rock_i % OBJECT_TYPES[t].sprite_count;
+        x_pos = rnd(-SPRITE_WIDTH[sprite]/2 + SPRITE_WIDTH[sprite]/15, SCREEN_WIDTH - SPRITE_WIDTH[sprite]/2 - SPRITE_WIDTH[sprite]/15)*1.0;
+    }
+
+    // draw_rock:
+    //  - Render the bitmap at (x_pos,y_pos) scaled by 0.1
+    //  - Move according to velocity, slowed if power‑up active
+    void draw_rock(const bool &power_up)
+    {
+        render_rock();
+        move_rock(power_up);
+    }
+
+    // render_rock: draw the bitmap at the current position without moving it
+    void render_rock()
+    {
+        RENDERER->draw_sprite(sprite, x_pos, y_pos, 0.1);
+    }
+
+    // move_rock: one frame of incremental movement, slowed if power‑up active
+    void move_rock(const bool &power_up)
+    {
+        if (power_up)
+        {
+            x_pos+=velocity[0]/10;
+            y_pos+=velocity[1]/10;
+        }
+        else
+        {
+            x_pos+=velocity[0];
+            y_pos+=velocity[1];
+        }
+    }
+
+    // track_rock (debug):
+    //  - Draw a collision circle around the rock’s center
+    void track_rock()
+    {
+        double x = x_pos + SPRITE_WIDTH[sprite]/2;
+        double y = y_pos + SPRITE_HEIGHT[sprite]/2;
+        double radius = SPRITE_WIDTH[sprite]/25;
+        RENDERER->draw_circle(color_black(), x, y, radius);
+    }
+};
+
+// Struct trajectory_integral
+// Running prefix integrals of the per-frame movement shared by every rock, so a rock's
+// position on any frame is a closed form of its spawn point instead of a per-frame update
+//   fall[k]  – sum of slow factors (1, or 0.1 while time slow is active) over frames before k
+//   drift[k] – sum of wind velocity × slow factor over frames before k
+// A rock only picks up the wind velocity after its first frame, so its drift starts at spawn + 1.
+// Only frames from base onwards are kept; trim() drops those older than every live rock.
+struct trajectory_integral
+{
+    static const unsigned int TRIM_STEP = 1024;// Frames to accumulate before shifting the arrays down
+
+    dynamic_array<double> *fall;
+    dynamic_array<double> *drift;
+    unsigned int base;// Frame stored at index 0
+    double last_wind;// Wind velocity rocks carry into the current frame
+
+    trajectory_integral()
+    {
+        fall = new dynamic_array<double>(0);
+        drift = new dynamic_array<double>(0);
+        fall->add(0);
+        drift->add(0);
+        base = 0;
+        last_wind = 0;
+    }
+
+    ~trajectory_integral()
+    {
+        delete fall;
+        delete drift;
+    }
+
+    // tick: index of the frame currently being played
+    unsigned int tick()
+    {
+        return base + fall->size - 1;
+    }
+
+    // advance: record the movement of the current frame, then step to the next one
+    void advance(double wind_velocity, bool slow)
+    {
+        double factor = slow ? 0.1 : 1.0;
+        int k = fall->size - 1;
+        fall->add(fall->data[k] + factor);
+        drift->add(drift->data[k] + last_wind*factor);
+        last_wind = wind_velocity;
+    }
+
+    // trim: forget frames before oldest (the earliest spawn_tick still placed), in TRIM_STEP chunks
+    void trim(unsigned int oldest)
+    {
+        if (oldest < base + TRIM_STEP)
+        {
+            return;
+        }
+        int drop = oldest - base;
+        int keep = fall->size - drop;
+        memmove(fall->data, fall->data + drop, keep * sizeof(double));
+        memmove(drift->data, drift->data + drop, keep * sizeof(double));
+        fall->size = keep;
+        drift->size = keep;
+        base = oldest;
+    }
+
+    // place: set the rock's position for frame k (spawn_tick <= k <= tick()) from its spawn point
+    void place(rock_ &rock, unsigned int k)
+    {
+        unsigned int s = rock.spawn_tick - base;
+        unsigned int f = k - base;
+        unsigned int d = f > s + 1 ? f : s + 1;
+        rock.x_pos = rock.spawn_x + drift->data[d] - drift->data[s + 1];
+        rock.y_pos = rock.spawn_y + rock.velocity[1]*(fall->data[f] - fall->data[s]);
+    }
+};
+
+// Struct trajectory_schedule
+// Random wind, time slow and spawn pattern replayed identically by each verify_trajectories pass
+struct trajectory_schedule
+{
+    int frames;
+    int *wind;
+    bool *slow;
+    bool *spawn;
+    rock_ *rocks;// Spawned rocks in spawn order, at their spawn points
+    int rock_count;
+
+    trajectory_schedule(int _frames)
+    {
+        frames = _frames;
+        wind = (int *)tracked_malloc(frames * sizeof(int), ALLOC_ARRAYS);
+        slow = (bool *)tracked_malloc(frames * sizeof(bool), ALLOC_ARRAYS);
+        spawn = (bool *)tracked_malloc(frames * sizeof(bool), ALLOC_ARRAYS);
+        rocks = (rock_ *)tracked_malloc(frames * sizeof(rock_), ALLOC_ROCKS);
+        rock_count = 0;
+
+        int w = 0;
+        bool s = false;
+        for (int k = 0; k < frames; k++)
+        {
+            if (rnd() < 0.01)
+            {
+                w = rnd(-MAX_WIND, MAX_WIND);
+            }
+            if (rnd() < 0.01)
+            {
+                s = !s;
+            }
+            wind[k] = w;
+            slow[k] = s;
+            spawn[k] = rnd() < 0.05;
+            if (spawn[k])
+            {
+                new(&rocks[rock_count]) rock_();
+                rocks[rock_count].spawn_tick = k;
+                rocks[rock_count].spawn_x = rocks[rock_count].x_pos;
+                rocks[rock_count].spawn_y = rocks[rock_count].y_pos;
+                rock_count++;
+            }
+        }
+    }
+
+    ~trajectory_schedule()
+    {
+        for (int i = 0; i < rock_count; i++)
+        {
+            rocks[i].~rock_();
+        }
+        tracked_free(wind);
+        tracked_free(slow);
+        tracked_free(spawn);
+        tracked_free(rocks);
+    }
+};
+
+// verify_trajectories: replay one random schedule three times
+//  - incremental only and closed form only, each timed, reported in ns per rock per frame
+//  - both side by side, returning the largest position difference seen
+// Rocks retire once they pass the bottom of the screen, as in the game.
+double verify_trajectories(int frames)
+{
+    trajectory_schedule schedule(frames);
+    rock_ *stepped = (rock_ *)tracked_malloc(frames * sizeof(rock_), ALLOC_ROCKS);
+    rock_ *placed = (rock_ *)tracked_malloc(frames * sizeof(rock_), ALLOC_ROCKS);
+    dynamic_array<int> live(0);
+    long long updates = 0;
+
+    // Incremental pass
+    auto start = std::chrono::steady_clock::now();
+    int next = 0;
+    for (int k = 0; k < frames; k++)
+    {
+        if (schedule.spawn[k])
+        {
+            new(&stepped[next]) rock_(schedule.rocks[next]);
+            live.add(next++);
+        }
+        int i = 0;
+        while (i < live.size)
+        {
+            rock_ &rock = stepped[live.data[i]];
+            rock.move_rock(schedule.slow[k]);
+            rock.velocity[0] = schedule.wind[k]*0.1;
+            updates++;
+            if (rock.y_pos >= SCREEN_HEIGHT)
+            {
+                live.remove_unordered(i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+    double incremental_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / updates;
+
+    // Closed-form pass
+    trajectory_integral lazy;
+    live.size = 0;
+    updates = 0;
+    next = 0;
+    start = std::chrono::steady_clock::now();
+    for (int k = 0; k < frames; k++)
+    {
+        if (schedule.spawn[k])
+        {
+            new(&placed[next]) rock_(schedule.rocks[next]);
+            live.add(next++);
+        }
+        lazy.advance(schedule.wind[k]*0.1, schedule.slow[k]);
+        unsigned int oldest = k;
+        int i = 0;
+        while (i < live.size)
+        {
+            rock_ &rock = placed[live.data[i]];
+            lazy.place(rock, k + 1);
+            updates++;
+            if (rock.y_pos >= SCREEN_HEIGHT)
+            {
+                live.remove_unordered(i);
+            }
+            else
+            {
+                oldest = rock.spawn_tick < oldest ? rock.spawn_tick : oldest;
+                i++;
+            }
+        }
+        lazy.trim(oldest);
+    }
+    double lazy_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / updates;
+
+    // Side-by-side pass
+    trajectory_integral integral;
+    live.size = 0;
+    next = 0;
+    double max_error = 0;
+    for (int k = 0; k < frames; k++)
+    {
+        if (schedule.spawn[k])
+        {
+            new(&stepped[next]) rock_(schedule.rocks[next]);
+            new(&placed[next]) rock_(schedule.rocks[next]);
+            live.add(next++);
+        }
+        integral.advance(schedule.wind[k]*0.1, schedule.slow[k]);
+        unsigned int oldest = k;
+        int i = 0;
+        while (i < live.size)
+        {
+            rock_ &rock = stepped[live.data[i]];
+            rock.move_rock(schedule.slow[k]);
+            rock.velocity[0] = schedule.wind[k]*0.1;
+            integral.place(placed[live.data[i]], k + 1);
+            max_error = fmax(max_error, fabs(placed[live.data[i]].x_pos - rock.x_pos));
+            max_error = fmax(max_error, fabs(placed[live.data[i]].y_pos - rock.y_pos));
+            if (rock.y_pos >= SCREEN_HEIGHT)
+            {
+                live.remove_unordered(i);
+            }
+            else
+            {
+                oldest = rock.spawn_tick < oldest ? rock.spawn_tick : oldest;
+                i++;
+            }
+        }
+        integral.trim(oldest);
+    }
+
+    printf("Trajectory update: %.2f ns incremental, %.2f ns closed form per rock per frame\n", incremental_ns, lazy_ns);
+    for (int i = 0; i < schedule.rock_count; i++)
+    {
+        stepped[i].~rock_();
+        placed[i].~rock_();
+    }
+    tracked_free(stepped);
+    tracked_free(placed);
+    return max_error;
+}
+
+// Struct player_
+// Holds player health, position (centered at bottom), and collision radius
+struct player_ : tracked<ALLOC_GAME>
+{
+    double health;
+    point_2d player_pos;
+    double radius;
+
+    // Constructor: set initial health, center bottom screen, fixed radius
+    player_(int _health)
+    {
+        health = _health;
+        player_pos.x = SCREEN_WIDTH/2;
+        player_pos.y = SCREEN_HEIGHT - 50;
+        radius = 50;
+    }
+};
+
+// Struct session_record
+// One finished game as stored in HISTORY_FILE (fixed size, native byte order)
+struct session_record
+{
+    int difficulty;
+    int score;
+    int accuracy;
+    unsigned int duration_ms;
+    unsigned int seed;// Value passed to srand() for the session's rock stream
+    unsigned int checksum;// record_checksum() of the fields above, so torn writes are skipped on load
+};
+
+// record_checksum: FNV-1a over every field before checksum
+unsigned int record_checksum(const session_record &record)
+{
+    const unsigned char *bytes = (const unsigned char *)&record;
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(session_record, checksum); i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Struct leaderboard
+// Top LEADERBOARD_SIZE scores as a min-heap (O(log n) insert) plus running aggregates for one difficulty
+struct leaderboard
+{
+    int heap[LEADERBOARD_SIZE];
+    int heap_size;
+
+    long long games;
+    long long total_score;
+    long long total_accuracy;
+    long long total_duration_ms;
+    int best_score;
+    int best_accuracy;
+
+    leaderboard()
     {
-        if (index < 0 || index >= size)
-        {
-            return 0; // Return the default value
-        }
-        return data[index]; // Return the value at the index
+        heap_size = 0;
+        games = 0;
+        total_score = 0;
+        total_accuracy = 0;
+        total_duration_ms = 0;
+        best_score = 0;
+        best_accuracy = 0;
     }
 
-    // set: safe assignment with bounds check
-    bool set(unsigned int index, T value)
+    void insert(const session_record &record)
     {
-        if (index >= size)
+        games++;
+        total_score += record.score;
+        total_accuracy += record.accuracy;
+        total_duration_ms += record.duration_ms;
+        if (record.score > best_score)
         {
-            return false;
+            best_score = record.score;
+        }
+        if (record.accuracy > best_accuracy)
+        {
+            best_accuracy = record.accuracy;
         }
 
-        data[index] = value;
-        return true;
+        if (heap_size < LEADERBOARD_SIZE)
+        {
+            // Sift up from the new leaf
+            int i = heap_size++;
+            heap[i] = record.score;
+            while (i > 0 && heap[(i - 1)/2] > heap[i])
+            {
+                int parent = (i - 1)/2;
+                int tmp = heap[parent];
+                heap[parent] = heap[i];
+                heap[i] = tmp;
+                i = parent;
+            }
+        }
+        else if (record.score > heap[0])
+        {
+            // Replace the lowest kept score and sift down
+            heap[0] = record.score;
+            int i = 0;
+            while (true)
+            {
+                int smallest = i;
+                int left = 2*i + 1;
+                int right = 2*i + 2;
+                if (left < heap_size && heap[left] < heap[smallest])
+                {
+                    smallest = left;
+                }
+                if (right < heap_size && heap[right] < heap[smallest])
+                {
+                    smallest = right;
+                }
+                if (smallest == i)
+                {
+                    break;
+                }
+                int tmp = heap[smallest];
+                heap[smallest] = heap[i];
+                heap[i] = tmp;
+                i = smallest;
+            }
+        }
     }
 
-    // print: debug helper to log contents, size, and capacity
-    void print()
+    // top: copy the kept scores into out, highest first; returns how many were written
+    int top(int out[LEADERBOARD_SIZE])
     {
-        printf("Dynamic array capacity: %d\n", capacity);
-        printf("Dynamic array size: %d\n", size);
-        printf("Dynamic array: [");
-        for (int i = 0; i < size; i++)
+        for (int i = 0; i < heap_size; i++)
         {
-            printf("%d", data[i]);
-            if (i < size - 1)
+            int j = i;
+            while (j > 0 && out[j - 1] < heap[i])
             {
-                printf(", ");
+                out[j] = out[j - 1];
+                j--;
             }
+            out[j] = heap[i];
         }
-        printf("]\n");
+        return heap_size;
     }
-};
 
-// Enum _type
-// Defines the categories of falling objects in the game
-//   ROCK      – standard damaging object
-//   POTION    – health restore
-//   TIME_SLOW – slows drop speed temporarily
-//   COIN      – bonus score
-enum  _type {
-    ROCK,
-    POTION,
-    TIME_SLOW,
-    COIN,
+    int average_score()
+    {
+        return games == 0 ? 0 : total_score / games;
+    }
 };
 
-// Struct rock_
-// Represents a single falling object (rock or power‑up)
-// Holds position, velocity, bitmap pointer, type flags, and status (draw/hit/missed)
-struct rock_{
-    double x_pos;
-    double y_pos;
-    bitmap *image;
-    double velocity[2];
-    bool draw;
-    bool missed;
-    bool hit;
-    _type t;
+// Struct session_history
+// Append-only binary log of session_records with an in-memory leaderboard per difficulty
+//  - The file starts with HISTORY_MAGIC; records failing their checksum are skipped, and a
+//    trailing partial record (e.g. from a crash) is zero-padded before appending so later records stay aligned
+//  - A file too short to hold the magic (a crash during the first write) is started over
+//  - Loading streams the file in fixed-size blocks, so only the leaderboards stay in memory
+struct session_history : tracked<ALLOC_GAME>
+{
+    static const unsigned int HISTORY_MAGIC = 0x31534452;// "RDS1"
+    static const int LOAD_BLOCK = 4096;// Records read per fread when loading
 
-    // Constructor:
-    //  - Randomly choose image index and type based on POTION_RATE, TIME_SLOW_RATE, COIN_RATE
-    //  - Initialize above-screen y position and random downward velocity
-    rock_()
-    {  
-        int rock_i = rnd(5);
+    leaderboard boards[DIFFICULTY_COUNT];
+    FILE *file;
+    string path;
+    bool restart;// File is empty or its header is torn, so rewrite it from scratch
 
-        y_pos = -bitmap_height("Rock_"+to_string(rock_i))*0.45;
-        velocity[0] = 0;
-        velocity[1] = rnd(20,100)/100.0;
-        draw=true;
-        missed=false;
-        hit=false;
-        float x_ = rnd();
-        if (x_ < POTION_RATE)
+    session_history(const string &_path)
+    {
+        path = _path;
+        file = nullptr;
+        restart = false;
+        if (!load())
         {
-            t = POTION;
-            image = &IMAGES[5];
+            return;
         }
-        else if (x_ < POTION_RATE + TIME_SLOW_RATE)
+
+        file = fopen(path.c_str(), restart ? "wb" : "ab");
+        if (file == nullptr)
         {
-            t = TIME_SLOW;
-            image = &IMAGES[6];
+            printf("Could not open %s, session history will not be saved\n", path.c_str());
+            return;
         }
-        else if (x_ < POTION_RATE + TIME_SLOW_RATE + COIN_RATE)
+
+        fseek(file, 0, SEEK_END);
+        long end = ftell(file);
+        if (end == 0)
         {
-            t = COIN;
-            image = &IMAGES[7];
+            unsigned int magic = HISTORY_MAGIC;
+            fwrite(&magic, sizeof(magic), 1, file);
         }
         else
         {
-            t = ROCK;
-            image = &IMAGES[rock_i];
+            long partial = (end - (long) sizeof(unsigned int)) % (long) sizeof(session_record);
+            for (long i = partial; i > 0 && i < (long) sizeof(session_record); i++)
+            {
+                fputc(0, file);
+            }
         }
-        x_pos = rnd(-bitmap_width(*image)/2 + bitmap_width(*image)/15, SCREEN_WIDTH - bitmap_width(*image)/2 - bitmap_width(*image)/15)*1.0;
+        fflush(file);
     }
 
-    // draw_rock:
-    //  - Render the bitmap at (x_pos,y_pos) scaled by 0.1
-    //  - Move according to velocity, slowed if power‑up active
-    void draw_rock(const bool &power_up)
+    ~session_history()
     {
-        draw_bitmap(*image, x_pos, y_pos, option_scale_bmp(0.1,0.1));
-        if (power_up)
+        if (file != nullptr)
         {
-            x_pos+=velocity[0]/10;
-            y_pos+=velocity[1]/10;
+            fclose(file);
         }
-        else
+    }
+
+    // load: stream existing records into the leaderboards; false if the file is not a history file
+    bool load()
+    {
+        FILE *in = fopen(path.c_str(), "rb");
+        if (in == nullptr)
         {
-            x_pos+=velocity[0];
-            y_pos+=velocity[1];
+            return true;
+        }
+
+        unsigned int magic = 0;
+        if (fread(&magic, 1, sizeof(magic), in) < sizeof(magic))
+        {
+            fclose(in);
+            restart = true;
+            return true;
+        }
+        if (magic != HISTORY_MAGIC)
+        {
+            fclose(in);
+            printf("%s is not a session history file, session history will not be saved\n", path.c_str());
+            return false;
         }
+
+        session_record *block = (session_record *)tracked_malloc(LOAD_BLOCK * sizeof(session_record), ALLOC_ARRAYS);
+        size_t count;
+        while ((count = fread(block, sizeof(session_record), LOAD_BLOCK, in)) > 0)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (block[i].checksum == record_checksum(block[i]))
+                {
+                    index(block[i]);
+                }
+            }
+        }
+        tracked_free(block);
+        fclose(in);
+        return true;
     }
 
-    // track_rock (debug):
-    //  - Draw a collision circle around the rock’s center
-    void track_rock()
+    // index: add a record to its difficulty's leaderboard, skipping anything out of range
+    void index(const session_record &record)
     {
-        double x = x_pos + bitmap_width(*image)/2;
-        double y = y_pos + bitmap_height(*image)/2;
-        double radius = bitmap_width(*image)/25;
-        draw_circle(color_black(), x, y, radius);
+        if (record.difficulty >= 0 && record.difficulty < DIFFICULTY_COUNT)
+        {
+            boards[record.difficulty].insert(record);
+        }
     }
-};
-
-// Struct player_
-// Holds player health, position (centered at bottom), and collision radius
-struct player_
-{
-    double health;
-    point_2d player_pos;
-    double radius;
 
-    // Constructor: set initial health, center bottom screen, fixed radius
-    player_(int _health)
+    // append: write the record to the end of the log and index it
+    void append(session_record record)
     {
-        health = _health;
-        player_pos.x = SCREEN_WIDTH/2;
-        player_pos.y = SCREEN_HEIGHT - 50;
-        radius = 50;
+        record.checksum = record_checksum(record);
+        if (file != nullptr)
+        {
+            fwrite(&record, sizeof(record), 1, file);
+            fflush(file);
+        }
+        index(record);
     }
 };
 
+// Session history, opened in main()
+session_history *HISTORY = nullptr;
+
 // Struct stats_page
 // Calculates post‑game stats (hits vs misses) and renders the Game Over menu
 struct stats_page
@@ -306,11 +1676,13 @@ struct stats_page
     int score;
     int dodge_accuracy;
     dynamic_array<rock_ *> *rock_history;
+    leaderboard *bests;// Personal bests for the difficulty just played
 
-    stats_page(int _score, dynamic_array<rock_ *> *_rock_history)
+    stats_page(int _score, dynamic_array<rock_ *> *_rock_history, leaderboard *_bests)
     {
         score = _score;
         rock_history = _rock_history;
+        bests = _bests;
     }
 
     // calc_stats: tally missed/hit from rock_history and compute dodge_accuracy
@@ -359,21 +1731,31 @@ struct stats_page
         {
             btn_color = color_dark_gray();
         }
-        fill_rectangle(btn_color, x, SCREEN_HEIGHT*5/6, SCREEN_WIDTH/5,100);
+        RENDERER->fill_rectangle(btn_color, x, SCREEN_HEIGHT*5/6, SCREEN_WIDTH/5,100);
     }
 
     // draw_stats: main loop to display stats and capture user choice (EXIT vs MENU)
     int draw_stats()
     {
         calc_stats();
+        int top_scores[LEADERBOARD_SIZE];
+        int top_count = bests->top(top_scores);
         while(!quit_requested())
         {
             process_events();
 
-            clear_screen(color_white());
-            draw_text("Game Over", color_black(), FONT1, FONT_SIZE*5, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/3 - 120 );
-            draw_text("Score: " + to_string(score), color_black(), FONT1, FONT_SIZE, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/3  + FONT_SIZE*2 );
-            draw_text("Dodge Accuracy: " + to_string((int)dodge_accuracy) + "%", color_black(), FONT1, FONT_SIZE, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/2);
+            RENDERER->clear(color_white());
+            RENDERER->draw_text("Game Over", color_black(), FONT1, FONT_SIZE*5, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/3 - 120 );
+            RENDERER->draw_text("Score: " + to_string(score), color_black(), FONT1, FONT_SIZE, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/3  + FONT_SIZE*2 );
+            RENDERER->draw_text("Dodge Accuracy: " + to_string((int)dodge_accuracy) + "%", color_black(), FONT1, FONT_SIZE, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/2);
+            RENDERER->draw_text("Personal Best: " + to_string(bests->best_score) + "   Best Accuracy: " + to_string(bests->best_accuracy) + "%", color_black(), FONT1, FONT_SIZE, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/2 + FONT_SIZE*2);
+            RENDERER->draw_text("Games Played: " + to_string(bests->games) + "   Average Score: " + to_string(bests->average_score()), color_black(), FONT1, FONT_SIZE, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/2 + FONT_SIZE*3.5);
+
+            RENDERER->draw_text("Top Scores", color_black(), FONT1, FONT_SIZE, SCREEN_WIDTH*3/4, SCREEN_HEIGHT/3 + FONT_SIZE*2);
+            for (int i = 0; i < top_count; i++)
+            {
+                RENDERER->draw_text(to_string(i + 1) + ".  " + to_string(top_scores[i]), color_black(), FONT1, FONT_SIZE*2/3, SCREEN_WIDTH*3/4, SCREEN_HEIGHT/3 + FONT_SIZE*3.5 + i*FONT_SIZE*0.8);
+            }
 
             for (int i =0; i < 2; i++)
             {
@@ -384,10 +1766,11 @@ struct stats_page
                     return i;
                 }
             }
-            draw_text("EXIT",color_red(),FONT1, FONT_SIZE,SCREEN_WIDTH/5 +FONT_SIZE*2, SCREEN_HEIGHT*4/6 + 150);
-            draw_text("MENU",color_red(),FONT1, FONT_SIZE,SCREEN_WIDTH*3/5 +FONT_SIZE*2, SCREEN_HEIGHT*4/6 + 150);
+            RENDERER->draw_text("EXIT",color_red(),FONT1, FONT_SIZE,SCREEN_WIDTH/5 +FONT_SIZE*2, SCREEN_HEIGHT*4/6 + 150);
+            RENDERER->draw_text("MENU",color_red(),FONT1, FONT_SIZE,SCREEN_WIDTH*3/5 +FONT_SIZE*2, SCREEN_HEIGHT*4/6 + 150);
 
-            refresh_screen();
+            RENDERER->present();
+            ALLOCATIONS.end_frame();
         }
         return 0;
     }
@@ -395,7 +1778,7 @@ struct stats_page
 
 // Struct menu
 // Renders the initial difficulty selection screen with EASY, MEDIUM, HARD, EXIT options
-struct menu
+struct menu : tracked<ALLOC_GAME>
 {    
     menu()
     {
@@ -423,7 +1806,7 @@ struct menu
         {
             btn_color = color_dark_gray();
         }
-        fill_rectangle(btn_color, SCREEN_WIDTH/3, y, SCREEN_WIDTH/3,100);
+        RENDERER->fill_rectangle(btn_color, SCREEN_WIDTH/3, y, SCREEN_WIDTH/3,100);
     }
 
     // draw_menu: display menu, handle clicks, return selected difficulty index
@@ -433,8 +1816,8 @@ struct menu
         {
             process_events();
 
-            clear_screen(color_white());
-            draw_text("......ROCK DODGER......", color_orange(), FONT1, FONT_SIZE*2, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/3 - 120 );
+            RENDERER->clear(color_white());
+            RENDERER->draw_text("......ROCK DODGER......", color_orange(), FONT1, FONT_SIZE*2, SCREEN_WIDTH/2 -FONT_SIZE*10 ,SCREEN_HEIGHT/3 - 120 );
 
             for (int i =0; i < 400; i+=120)
             {
@@ -445,11 +1828,12 @@ struct menu
                     return i/120;
                 }
             }
-            draw_text("EXIT MENU",color_white(),FONT1, FONT_SIZE,SCREEN_WIDTH/2 -FONT_SIZE*3, SCREEN_HEIGHT/3 + 20);
-            draw_text("EASY", color_white(),FONT1, FONT_SIZE, SCREEN_WIDTH/2  -FONT_SIZE*2, SCREEN_HEIGHT/3 + 140);
-            draw_text("MEDIUM", color_white(),FONT1, FONT_SIZE, SCREEN_WIDTH/2  -FONT_SIZE*2, SCREEN_HEIGHT/3 + 260);
-            draw_text("HARD", color_white(),FONT1, FONT_SIZE, SCREEN_WIDTH/2 -FONT_SIZE*2, SCREEN_HEIGHT/3 + 380);
-            refresh_screen();
+            RENDERER->draw_text("EXIT MENU",color_white(),FONT1, FONT_SIZE,SCREEN_WIDTH/2 -FONT_SIZE*3, SCREEN_HEIGHT/3 + 20);
+            RENDERER->draw_text("EASY", color_white(),FONT1, FONT_SIZE, SCREEN_WIDTH/2  -FONT_SIZE*2, SCREEN_HEIGHT/3 + 140);
+            RENDERER->draw_text("MEDIUM", color_white(),FONT1, FONT_SIZE, SCREEN_WIDTH/2  -FONT_SIZE*2, SCREEN_HEIGHT/3 + 260);
+            RENDERER->draw_text("HARD", color_white(),FONT1, FONT_SIZE, SCREEN_WIDTH/2 -FONT_SIZE*2, SCREEN_HEIGHT/3 + 380);
+            RENDERER->present();
+            ALLOCATIONS.end_frame();
         }
         return 0;
     }
@@ -458,7 +1842,7 @@ struct menu
 // Struct game_state
 // Manages entire gameplay session:
 //  - Player object, rock queue/history, timers, wind, power‑ups, scoring, difficulty
-struct game_state
+struct game_state : tracked<ALLOC_GAME>
 {
     player_ *player;
     bool over;
@@ -467,14 +1851,17 @@ struct game_state
     
     dynamic_array<rock_ *> *rock_history;
     dynamic_array<rock_ *> *rock_queue;
+    dynamic_array<rock_ *> *active[TYPE_COUNT];//Released objects, one bucket per type
+    trajectory_integral *trajectory;// Lazy mode only
+    unsigned int oldest_spawn;// Earliest spawn_tick among released rocks still in play (lazy mode)
     
     unsigned int rock_release;
     unsigned int next_rock_time;
     unsigned long wind_change_time;
 
-    timer game_clock;
-    timer wind_clock;
-    timer slow_clock;
+    game_timer game_clock;
+    game_timer wind_clock;
+    game_timer slow_clock;
     
     double max_health;
     
@@ -485,15 +1872,20 @@ struct game_state
     double rock_softness;//To make the rock hurt less
     double acceleration;//To increase falling rate
 
-    // Constructor(difficulty):
-    //  - Set up timers, difficulty scaling (health, acceleration), load images
-    game_state(double _dif)
+    unsigned int seed;//Seed for this session's rock stream
+    unsigned int start_ticks;
+    unsigned int end_ticks;
+
+    // Constructor(difficulty, seed):
+    //  - Seed the rock stream, set up timers, difficulty scaling (health, acceleration), load images
+    game_state(double _dif, unsigned int _seed)
     {
-        game_clock = create_timer("game_clock");
-        wind_clock = create_timer("wind_clock");
-        slow_clock = create_timer("slow_clock");
         powerup_time = 0;
         difficulty = _dif;
+        seed = _seed;
+        srand(seed);
+        start_ticks = 0;
+        end_ticks = 0;
 
         if (_dif == 0)
         { 
@@ -513,6 +1905,12 @@ struct game_state
 
         rock_history = new dynamic_array<rock_ *>(0);
         rock_queue = new dynamic_array<rock_ *>(0);
+        for (int i = 0; i < TYPE_COUNT; i++)
+        {
+            active[i] = new dynamic_array<rock_ *>(0);
+        }
+        trajectory = LAZY_TRAJECTORIES ? new trajectory_integral() : nullptr;
+        oldest_spawn = 0;
 
         rock_release = 0;
         next_rock_time = 1000;
@@ -531,14 +1929,33 @@ struct game_state
         delete player;
         delete rock_history;
         delete rock_queue;
+        for (int i = 0; i < TYPE_COUNT; i++)
+        {
+            delete active[i];
+        }
+        delete trajectory;
     }
 
-    // load_images: preload all rock and power‑up bitmaps into IMAGES array
+    // load_images: preload all rock and power‑up bitmaps into IMAGES array and record their sizes
+    //  - Scripted runs have no display to load bitmaps into, so only the sizes are read from the files
+    //  - Bitmaps stay loaded across games, so only the first load is counted as an asset allocation
     void load_images()
     {
-        for (int i=0; i<8; i++)
+        if (SCRIPTED)
+        {
+            read_sprite_sizes();
+            return;
+        }
+        for (int i=0; i<SPRITE_COUNT; i++)
         {
+            bool loaded = has_bitmap("Rock_"+to_string(i));
             IMAGES[i] = load_bitmap("Rock_"+to_string(i), "./" + to_string(i) + ".png");
+            SPRITE_WIDTH[i] = bitmap_width(IMAGES[i]);
+            SPRITE_HEIGHT[i] = bitmap_height(IMAGES[i]);
+            if (!loaded)
+            {
+                ALLOCATIONS.on_alloc(ALLOC_ASSETS, (long long) SPRITE_WIDTH[i] * SPRITE_HEIGHT[i] * 4);
+            }
         }
     }
 
@@ -552,6 +1969,20 @@ struct game_state
         }
     }
 
+    // release_rock: move the next queued rock into the bucket for its type
+    void release_rock()
+    {
+        rock_ *rock = (*rock_queue)[rock_release];
+        if (LAZY_TRAJECTORIES)
+        {
+            rock->spawn_tick = trajectory->tick();
+            rock->spawn_x = rock->x_pos;
+            rock->spawn_y = rock->y_pos;
+        }
+        active[rock->t]->add(rock);
+        rock_release++;
+    }
+
     // remove_rock: flag rock as removed, record pointer in history
     void remove_rock(rock_ &rock)
     {
@@ -559,92 +1990,162 @@ struct game_state
         rock.draw = false;
     }
 
-    // draw_rocks: render, update, and handle collisions/misses for active rocks
-    void draw_rocks()
+    // collect: apply the pickup/damage effect of a type T object touching the player.
+    // Every condition is on a compile-time constant, so each instantiation only keeps its own effects.
+    template <_type T>
+    void collect(rock_ &rock)
     {
-        int j;
-        for (int i = 0; i< rock_release; i++)
+        constexpr object_type type = OBJECT_TYPES[T];
+
+        if (type.damage > 0)
+        {
+            player->health -= type.damage * rock.velocity[1]/rock_softness;
+        }
+        if (type.heal > 0)
         {
-            rock_ *rock = (*rock_queue)[i];
-            if (!rock->draw)
+            if (player->health + max_health*type.heal > max_health)
             {
-                continue;
+                player->health = max_health;
+            }
+            else
+            {
+                player->health += max_health*type.heal;
+            }
+        }
+        if (type.slow_time > 0)
+        {
+            slow_clock.resume();
+            if (powerup_time - slow_clock.ticks() + type.slow_time > MAX_TIME_SLOW)
+            {
+                powerup_time = MAX_TIME_SLOW + slow_clock.ticks();
+            }
+            else
+            {
+                powerup_time += type.slow_time;
+            }
+        }
+        if (type.score > 0)
+        {
+            score += type.score * difficulty;
+        }
+        if (type.track_misses)
+        {
+            rock.hit = true;
+            remove_rock(rock);
+        }
+        else
+        {
+            rock.draw = false;
+        }
+    }
+
+    // draw_bucket: render, update, and handle collisions/misses for the released objects of type T
+    //  - Lazy mode draws the position placed last frame (or the spawn point), then places the rock
+    //    once in closed form for the collision test and the next frame's draw
+    //  - Collision is only tested for rocks whose centre is within reach of the player vertically
+    //  - Lowers oldest_spawn to the earliest spawn_tick kept, so the integrals can be trimmed
+    template <_type T>
+    void draw_bucket(bool slow)
+    {
+        dynamic_array<rock_ *> *bucket = active[T];
+        unsigned int tick = LAZY_TRAJECTORIES ? trajectory->tick() : 0;
+        int i = 0;
+        while (i < bucket->size)
+        {
+            rock_ *rock = bucket->data[i];
+            if (LAZY_TRAJECTORIES)
+            {
+                rock->render_rock();
+                trajectory->place(*rock, tick);
             }
             else
             {
-                rock->draw_rock(powerup_time>0);
+                rock->draw_rock(slow);
                 rock->velocity[0] = wind*0.1;
-                if (circles_intersect(
-                    (rock->x_pos + (double) bitmap_width(*rock->image)/2),
-                    (rock->y_pos + (double) bitmap_height(*rock->image)/2),
-                    bitmap_width(*rock->image)/25,
-                    player->player_pos.x,
-                    player->player_pos.y,
-                    player->radius)
-                )
+            }
+
+            double radius = SPRITE_WIDTH[rock->sprite]/25;
+            double centre_y = rock->y_pos + (double) SPRITE_HEIGHT[rock->sprite]/2;
+            if (fabs(centre_y - player->player_pos.y) <= radius + player->radius && circles_intersect(
+                (rock->x_pos + (double) SPRITE_WIDTH[rock->sprite]/2),
+                centre_y,
+                radius,
+                player->player_pos.x,
+                player->player_pos.y,
+                player->radius)
+            )
+            {
+                collect<T>(*rock);
+            }
+            else if (centre_y>=SCREEN_HEIGHT)
+            {
+                // Off the bottom of the screen: only tracked types count it as a dodge
+                if (OBJECT_TYPES[T].track_misses)
+                {
+                    rock->missed = true;
+                    remove_rock(*rock);
+                }
+                else
                 {
-                    switch (rock->t)
-                    {
-                        case ROCK:
-                            player->health-=rock->velocity[1]/rock_softness;
-                            rock->hit = true;
-                            remove_rock(*rock);
-                            break;
-                        case POTION:
-                            rock->draw = false;
-                            if (player->health + max_health/8.0 > max_health)
-                            {
-                                player->health = max_health;
-                            }
-                            else
-                            {
-                                player->health += max_health/8.0;
-                            }
-                            break;
-                        case TIME_SLOW:
-                            rock->draw = false;
-                            resume_timer(slow_clock);
-                            if (powerup_time - timer_ticks(slow_clock) + 2000 > MAX_TIME_SLOW)
-                            {
-                                powerup_time = MAX_TIME_SLOW + timer_ticks(slow_clock);
-                            }
-                            else
-                            {
-                                powerup_time += 2000;
-                            }
-                            break;
-                        case COIN:
-                            rock->draw = false;
-                            score+= difficulty;
-                            break;
-                    }
-                    
+                    rock->draw = false;
                 }
-                
-                else if (((*rock).y_pos + bitmap_height(*(*rock).image)/2)>=SCREEN_HEIGHT && !(*rock).missed)
+            }
+
+            if (rock->draw)
+            {
+                if (LAZY_TRAJECTORIES && rock->spawn_tick < oldest_spawn)
                 {
-                    if (rock->t == ROCK)
-                    {
-                        rock->missed = true;
-                        remove_rock(*rock);
-                    }
+                    oldest_spawn = rock->spawn_tick;
                 }
-            } 
+                i++;
+            }
+            else
+            {
+                bucket->remove_unordered(i);
+            }
+        }
+    }
+
+    // draw_buckets: walk every _type at compile time, one specialised draw_bucket per type
+    template <int T>
+    void draw_buckets(std::integral_constant<int, T>, bool slow)
+    {
+        draw_bucket<(_type) T>(slow);
+        draw_buckets(std::integral_constant<int, T + 1>(), slow);
+    }
+    void draw_buckets(std::integral_constant<int, TYPE_COUNT>, bool /*slow*/)
+    {
+    }
+
+    // draw_rocks: advance the trajectory integrals one frame (lazy mode), then render and update all
+    // released objects bucket by bucket. Time slow is sampled once so every rock moves alike.
+    void draw_rocks()
+    {
+        bool slow = powerup_time>0;
+        if (LAZY_TRAJECTORIES)
+        {
+            trajectory->advance(wind*0.1, slow);
+            oldest_spawn = trajectory->tick() - 1;
+        }
+        draw_buckets(std::integral_constant<int, ROCK>(), slow);
+        if (LAZY_TRAJECTORIES)
+        {
+            trajectory->trim(oldest_spawn);
         }
     }
 
     // handle_mechanics: spawn timing, wind updates, power‑up expiration, death check
     void handle_mechanics()
     {
-        if (timer_ticks(game_clock)>next_rock_time && rock_release < rock_queue->size)
+        if (game_clock.ticks()>next_rock_time && rock_release < rock_queue->size)
         {
-            rock_release++;
-            reset_timer(game_clock);
+            release_rock();
+            game_clock.reset();
             next_rock_time = rnd(500, 1500)/(1 + (rock_release*acceleration));
         }
-        if (timer_ticks(wind_clock)>wind_change_time)
+        if (wind_clock.ticks()>wind_change_time)
         {
-            reset_timer(wind_clock);
+            wind_clock.reset();
             if (rnd(-1,1)>=0)
             {       
                 wind = rnd(1,MAX_WIND);
@@ -657,11 +2158,11 @@ struct game_state
             }
             wind_change_time = rnd(WIND_CHANGE_TIME/2, WIND_CHANGE_TIME);
         } 
-        if (powerup_time <= timer_ticks(slow_clock))
+        if (powerup_time <= slow_clock.ticks())
         {
-            reset_timer(slow_clock);
-            powerup_time = timer_ticks(slow_clock);
-            pause_timer(slow_clock);
+            slow_clock.reset();
+            powerup_time = slow_clock.ticks();
+            slow_clock.pause();
         }
         if (player->health <=0)
         {
@@ -669,11 +2170,24 @@ struct game_state
         }
     }
 
+    // draw_debug_overlay: allocation accounting, shown while SPACE is held
+    void draw_debug_overlay()
+    {
+        double y = SCREEN_HEIGHT/5;
+        for (int i = 0; i < ALLOC_CATEGORY_COUNT; i++)
+        {
+            RENDERER->draw_text(string(ALLOC_NAMES[i]) + ": " + to_string(ALLOCATIONS.live_bytes[i]) + " B live, " + to_string(ALLOCATIONS.allocations[i]) + " allocs", color_black(), FONT1, FONT_SIZE/2, 50, y);
+            y += FONT_SIZE*0.75;
+        }
+        RENDERER->draw_text("strings (est.): " + to_string(ALLOCATIONS.string_buffers) + " buffers, " + to_string(ALLOCATIONS.string_bytes) + " B", color_black(), FONT1, FONT_SIZE/2, 50, y);
+        y += FONT_SIZE*0.75;
+        RENDERER->draw_text("live: " + to_string(ALLOCATIONS.total_live) + " B, high-water: " + to_string(ALLOCATIONS.high_water) + " B", color_black(), FONT1, FONT_SIZE/2, 50, y);
+        RENDERER->draw_text("allocs/frame: " + to_string(ALLOCATIONS.last_frame_allocations) + " (peak " + to_string(ALLOCATIONS.peak_frame_allocations) + ")", color_black(), FONT1, FONT_SIZE/2, 50, y + FONT_SIZE*0.75);
+    }
+
     void debug_statements()
     {
-        write_line("Rock Release: " + to_string(rock_release));
-        write_line("Rock Queue Size: " + to_string(rock_queue->size));
-        write_line("Rock History Size: " + to_string(rock_history->size));
+        LOGGER->log(LOG_ROCK_COUNTS, rock_release, rock_queue->size, rock_history->size);
     }
 
     void handle_user_inputs()
@@ -704,12 +2218,12 @@ struct game_state
         double width = SCREEN_WIDTH/4;
         double height = 15;
 
-        double health_width = width * ((powerup_time - timer_ticks(slow_clock))/(float)MAX_TIME_SLOW);
-        draw_text("Power Bar " , color_black(), FONT1, FONT_SIZE, x_start,y_start - 50 );
+        double health_width = width * ((powerup_time - slow_clock.ticks())/(float)MAX_TIME_SLOW);
+        RENDERER->draw_text("Power Bar " , color_black(), FONT1, FONT_SIZE, x_start,y_start - 50 );
 
-        fill_rectangle(color_white(), x_start, y_start, width, height);
-        draw_rectangle(color_black(), x_start, y_start, width, height);
-        fill_rectangle(color_light_blue(), x_start, y_start, health_width, height);
+        RENDERER->fill_rectangle(color_white(), x_start, y_start, width, height);
+        RENDERER->draw_rectangle(color_black(), x_start, y_start, width, height);
+        RENDERER->fill_rectangle(color_light_blue(), x_start, y_start, health_width, height);
     }
 
     // draw_health: show player health bar and current score
@@ -722,10 +2236,10 @@ struct game_state
 
         double health_width = width * (player->health/max_health);
 
-        draw_text("SCORE : " + to_string((int) score), color_black(), FONT1, FONT_SIZE, 50 ,y_start );
+        RENDERER->draw_text("SCORE : " + to_string((int) score), color_black(), FONT1, FONT_SIZE, 50 ,y_start );
 
-        fill_rectangle(color_red(), x_start, y_start, width, height);
-        fill_rectangle(color_light_green(), x_start, y_start, health_width, height);
+        RENDERER->fill_rectangle(color_red(), x_start, y_start, width, height);
+        RENDERER->fill_rectangle(color_light_green(), x_start, y_start, health_width, height);
         if (powerup_time > 0)
         {
             draw_slow();
@@ -735,15 +2249,46 @@ struct game_state
     // draw_player: render the player as a filled circle above health bar
     void draw_player()
     {
-        fill_circle(color_black(), player->player_pos.x,player->player_pos.y - player->radius - 10,player->radius);
+        RENDERER->fill_circle(color_black(), player->player_pos.x,player->player_pos.y - player->radius - 10,player->radius);
+    }
+
+    // start_clocks: start the game timers at the beginning of a session
+    void start_clocks()
+    {
+        game_clock.start();
+        wind_clock.start();
+        slow_clock.start();
+        start_ticks = now_ms();
+    }
+
+    // play_frame: update and draw one frame (input is handled by the caller)
+    void play_frame(bool overlay)
+    {
+        populate_rock_queue();
+
+        handle_mechanics();
+
+        RENDERER->clear(color_white());
+
+        draw_rocks();
+
+        draw_player();
+
+        draw_health();
+
+        if (overlay)
+        {
+            draw_debug_overlay();
+        }
+
+        RENDERER->present();
+        ALLOCATIONS.end_frame();
     }
 
     // render_game: main game loop (update, draw, timers) until over or quit
     void render_game()
     {
-        start_timer(game_clock);
-        start_timer(wind_clock);
-        start_timer(slow_clock);
+        start_clocks();
         while (!quit_requested())
         {   
             if (over)
@@ -752,40 +2297,125 @@ struct game_state
             }
             process_events();
 
-            populate_rock_queue();
-
             handle_user_inputs();
 
-            handle_mechanics();
+            play_frame(key_down(SPACE_KEY));
+        }
+        end_ticks = now_ms();
+    }
 
-            clear_screen(color_white());
+    // run_scripted: headless loop of up to frames frames with no input, advancing the frame
+    // clock SCRIPTED_FRAME_MS per frame; returns the number of frames played
+    int run_scripted(int frames)
+    {
+        start_clocks();
+        int played = 0;
+        while (played < frames && !over)
+        {
+            play_frame(false);
+            SCRIPTED_TICKS += SCRIPTED_FRAME_MS;
+            played++;
+        }
+        end_ticks = now_ms();
+        return played;
+    }
 
-            draw_rocks();
+    // session: summarise the finished game for the session history
+    session_record session(int dodge_accuracy)
+    {
+        session_record record;
+        record.difficulty = (int) difficulty;
+        record.score = score;
+        record.accuracy = dodge_accuracy;
+        record.duration_ms = end_ticks - start_ticks;
+        record.seed = seed;
+        record.checksum = 0;
+        return record;
+    }
+};
 
-            draw_player();
+// session_seed: seed for an interactive session from the nanosecond clock, so games started
+// within the same second still get different rock streams
+unsigned int session_seed()
+{
+    unsigned long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return (unsigned int) (ns ^ (ns >> 32));
+}
 
-            draw_health();
+// env_int: integer environment variable, or fallback when unset
+int env_int(const char *name, int fallback)
+{
+    const char *value = getenv(name);
+    return value == nullptr ? fallback : atoi(value);
+}
 
-            refresh_screen();
-        }
-    }
-};
+// run_headless: scripted benchmark/golden-image run on the software renderer, no window or input
+//  - ROCK_DODGER_DIFFICULTY (default 2), ROCK_DODGER_FRAMES (default 600) and ROCK_DODGER_SEED
+//    (default 1) pick the run; with the frame clock the same settings replay the same frames
+//  - ROCK_DODGER_LAZY_TRAJECTORIES switches the run to closed-form rock placement, for comparison
+//  - Prints frames played and wall time per frame
+int run_headless()
+{
+    SCRIPTED = true;
+    const char *frame_dump = getenv("ROCK_DODGER_FRAME_DUMP");
+    const char *frame_format = getenv("ROCK_DODGER_FRAME_FORMAT");
+    RENDERER = new software_renderer(SCREEN_WIDTH, SCREEN_HEIGHT, frame_dump == nullptr ? "" : frame_dump,
+        frame_format != nullptr && strcmp(frame_format, "png") == 0);
+
+    int frames = env_int("ROCK_DODGER_FRAMES", 600);
+    game_state *game = new game_state(env_int("ROCK_DODGER_DIFFICULTY", 2), env_int("ROCK_DODGER_SEED", 1));
+
+    auto start = std::chrono::steady_clock::now();
+    int played = game->run_scripted(frames);
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("Rendered %d frames in %.1f ms (%.3f ms per frame), %s trajectories\n", played, elapsed_ms, played == 0 ? 0 : elapsed_ms/played, LAZY_TRAJECTORIES ? "lazy" : "incremental");
+
+    delete game;
+    delete RENDERER;
+    ALLOCATIONS.print();
+    return 0;
+}
 
 // main: application entry point
 //  - Loop: show menu → run game → show stats → exit or restart
+//  - With ROCK_DODGER_RENDERER=software, runs run_headless() instead
 int main()  
 {   
+    LAZY_TRAJECTORIES = getenv("ROCK_DODGER_LAZY_TRAJECTORIES") != nullptr;
+    if (getenv("ROCK_DODGER_VERIFY_TRAJECTORIES") != nullptr)
+    {
+        read_sprite_sizes();
+        double error = verify_trajectories(100000);
+        printf("Trajectory max error: %g\n", error);
+        return error < 1e-6 ? 0 : 1;
+    }
+
+    const char *backend = getenv("ROCK_DODGER_RENDERER");
+    if (backend != nullptr && strcmp(backend, "software") == 0)
+    {
+        return run_headless();
+    }
+
     open_window("ROCK DODGER", SCREEN_WIDTH, SCREEN_HEIGHT);
+    LOGGER = new logger();
+    HISTORY = new session_history(HISTORY_FILE);
+    RENDERER = new splashkit_renderer();
+
     while (true)
     {
         menu *game_menu = new menu();
 
-        game_state *game = new game_state((double)game_menu->draw_menu());
+        game_state *game = new game_state((double)game_menu->draw_menu(), session_seed());
         delete game_menu;
 
         game->render_game();
       
-        stats_page stats = stats_page(game->score, game->rock_history);        
+        stats_page stats = stats_page(game->score, game->rock_history, &HISTORY->boards[(int) game->difficulty]);        
+        stats.calc_stats();
+        if (game->difficulty > 0)
+        {
+            HISTORY->append(game->session(stats.dodge_accuracy));
+        }
         int user_opt = stats.draw_stats();
 
         delete game;
@@ -794,6 +2424,11 @@ int main()
            break;
         }
     } 
+    delete RENDERER;
+    delete LOGGER;
+    delete HISTORY;
+    unload_images();
+    ALLOCATIONS.print();
     return 0;
     write_line("Thanks for playing!");
 }